@@ -1,12 +1,16 @@
 #include <ncurses.h>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <fstream>
 #include <sstream>
 #include <filesystem>
 #include <algorithm>
+#include <bitset>
 #include <cstdlib>
+#include <cstdint>
+#include <cstring>
 
 namespace fs = std::filesystem;
 
@@ -26,19 +30,865 @@ static short hexToNcurses(const std::string& hex, char channel) {
     return (short)(val * 1000 / 255);
 }
 
+// Streaming XXH64. Lets a tab tell whether its buffer still matches the
+// version on disk without keeping a second copy of the file around.
+class ContentHash {
+public:
+    ContentHash() {
+        v[0] = P1 + P2;
+        v[1] = P2;
+        v[2] = 0;
+        v[3] = 0 - P1;
+    }
+
+    void update(const char* data, size_t len) {
+        const unsigned char* p = (const unsigned char*)data;
+        const unsigned char* end = p + len;
+        total += len;
+
+        if (bufLen + len < 32) {
+            memcpy(buf + bufLen, p, len);
+            bufLen += len;
+            return;
+        }
+
+        if (bufLen > 0) {
+            size_t fill = 32 - bufLen;
+            memcpy(buf + bufLen, p, fill);
+            consume(buf);
+            p += fill;
+            bufLen = 0;
+        }
+
+        for (; p + 32 <= end; p += 32) {
+            consume(p);
+        }
+
+        bufLen = end - p;
+        memcpy(buf, p, bufLen);
+    }
+
+    void update(const std::string& s) {
+        update(s.data(), s.size());
+    }
+
+    uint64_t digest() const {
+        uint64_t h;
+        if (total >= 32) {
+            h = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+            for (int i = 0; i < 4; i++) {
+                h = (h ^ round(0, v[i])) * P1 + P4;
+            }
+        } else {
+            h = P5;
+        }
+        h += total;
+
+        const unsigned char* p = buf;
+        const unsigned char* end = buf + bufLen;
+        for (; p + 8 <= end; p += 8) {
+            h ^= round(0, read64(p));
+            h = rotl(h, 27) * P1 + P4;
+        }
+        if (p + 4 <= end) {
+            h ^= (uint64_t)read32(p) * P1;
+            h = rotl(h, 23) * P2 + P3;
+            p += 4;
+        }
+        for (; p < end; p++) {
+            h ^= *p * P5;
+            h = rotl(h, 11) * P1;
+        }
+
+        h ^= h >> 33;
+        h *= P2;
+        h ^= h >> 29;
+        h *= P3;
+        h ^= h >> 32;
+        return h;
+    }
+
+private:
+    static constexpr uint64_t P1 = 0x9E3779B185EBCA87ULL;
+    static constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+    static constexpr uint64_t P3 = 0x165667B19E3779F9ULL;
+    static constexpr uint64_t P4 = 0x85EBCA77C2B2AE63ULL;
+    static constexpr uint64_t P5 = 0x27D4EB2F165667C5ULL;
+
+    uint64_t v[4];
+    uint64_t total = 0;
+    unsigned char buf[32];
+    size_t bufLen = 0;
+
+    static uint64_t rotl(uint64_t x, int r) {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    static uint64_t read64(const unsigned char* p) {
+        uint64_t x;
+        memcpy(&x, p, 8);
+        return x;
+    }
+
+    static uint32_t read32(const unsigned char* p) {
+        uint32_t x;
+        memcpy(&x, p, 4);
+        return x;
+    }
+
+    static uint64_t round(uint64_t acc, uint64_t input) {
+        acc += input * P2;
+        return rotl(acc, 31) * P1;
+    }
+
+    void consume(const unsigned char* p) {
+        for (int i = 0; i < 4; i++) {
+            v[i] = round(v[i], read64(p + i * 8));
+        }
+    }
+};
+
+static uint64_t hashLine(const std::string& line) {
+    ContentHash h;
+    h.update(line);
+    return h.digest();
+}
+
+// A buffer's content hash is a polynomial over its line hashes modulo the
+// prime 2^61 - 1: H(a + b) = H(a) * B^|b| + H(b). Because any split into
+// pieces combines to the same value, tabs keep it per block of lines and an
+// edit only redoes its own block. Being line based, a missing final newline
+// on disk alone does not count as a change.
+struct LineDigest {
+    static constexpr uint64_t P = (1ULL << 61) - 1;
+    static constexpr uint64_t B = 0x16A09E667F3BCC9ULL;
+
+    uint64_t hash = 0;
+    uint64_t pow = 1;
+
+    static uint64_t mulMod(uint64_t a, uint64_t b) {
+        unsigned __int128 m = (unsigned __int128)a * b;
+        uint64_t r = (uint64_t)(m & P) + (uint64_t)(m >> 61);
+        return r >= P ? r - P : r;
+    }
+
+    static uint64_t addMod(uint64_t a, uint64_t b) {
+        uint64_t r = a + b;
+        return r >= P ? r - P : r;
+    }
+
+    void append(uint64_t lineHash) {
+        uint64_t h = (lineHash & P) + (lineHash >> 61);
+        hash = addMod(mulMod(hash, B), h >= P ? h - P : h);
+        pow = mulMod(pow, B);
+    }
+
+    void append(const LineDigest& other) {
+        hash = addMod(mulMod(hash, other.pow), other.hash);
+        pow = mulMod(pow, other.pow);
+    }
+};
+
+// Per-line hashes of a buffer, kept in blocks that split as they grow, each
+// caching its LineDigest. Mirrors the line edits handleEditorInput makes.
+class LineHashes {
+public:
+    void assign(const std::vector<std::string>& lines) {
+        blocks.clear();
+        for (size_t i = 0; i < lines.size(); i += BlockSize) {
+            Block block;
+            size_t end = std::min(lines.size(), i + BlockSize);
+            for (size_t j = i; j < end; j++) {
+                block.hashes.push_back(hashLine(lines[j]));
+            }
+            blocks.push_back(std::move(block));
+        }
+    }
+
+    void set(int y, const std::string& line) {
+        size_t b, off;
+        locate(y, b, off);
+        blocks[b].hashes[off] = hashLine(line);
+        blocks[b].dirty = true;
+    }
+
+    void insert(int y, const std::string& line) {
+        size_t b, off;
+        locate(y, b, off);
+        if (b == blocks.size()) {
+            b = blocks.empty() ? 0 : blocks.size() - 1;
+            if (blocks.empty()) blocks.emplace_back();
+            off = blocks[b].hashes.size();
+        }
+
+        Block& block = blocks[b];
+        block.hashes.insert(block.hashes.begin() + off, hashLine(line));
+        block.dirty = true;
+
+        if (block.hashes.size() >= 2 * BlockSize) {
+            Block tail;
+            tail.hashes.assign(block.hashes.begin() + BlockSize, block.hashes.end());
+            block.hashes.resize(BlockSize);
+            blocks.insert(blocks.begin() + b + 1, std::move(tail));
+        }
+    }
+
+    void erase(int y) {
+        size_t b, off;
+        locate(y, b, off);
+        blocks[b].hashes.erase(blocks[b].hashes.begin() + off);
+        blocks[b].dirty = true;
+        if (blocks[b].hashes.empty()) blocks.erase(blocks.begin() + b);
+    }
+
+    uint64_t digest() {
+        LineDigest total;
+        for (auto& block : blocks) {
+            if (block.dirty) {
+                block.digest = LineDigest();
+                for (uint64_t h : block.hashes) block.digest.append(h);
+                block.dirty = false;
+            }
+            total.append(block.digest);
+        }
+        return total.hash;
+    }
+
+private:
+    static constexpr size_t BlockSize = 512;
+
+    struct Block {
+        std::vector<uint64_t> hashes;
+        LineDigest digest;
+        bool dirty = true;
+    };
+
+    std::vector<Block> blocks;
+
+    // Block holding line y and its offset; blocks.size() if y is past the end
+    void locate(int y, size_t& b, size_t& off) const {
+        size_t rest = y;
+        for (b = 0; b < blocks.size(); b++) {
+            if (rest < blocks[b].hashes.size()) break;
+            rest -= blocks[b].hashes.size();
+        }
+        off = rest;
+    }
+};
+
+// Reads a file as buffer lines; an empty or missing file gives one empty line.
+static std::vector<std::string> readLines(const std::string& path) {
+    std::vector<std::string> lines;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+    if (lines.empty()) {
+        lines.push_back("");
+    }
+    return lines;
+}
+
+// Same normalization as readLines + LineHashes, streamed straight from disk.
+static uint64_t hashFile(const std::string& path) {
+    std::ifstream file(path);
+    LineDigest d;
+    std::string line;
+    bool any = false;
+    while (std::getline(file, line)) {
+        d.append(hashLine(line));
+        any = true;
+    }
+    if (!any) d.append(hashLine(""));
+    return d.hash;
+}
+
+// Bracket structure of a buffer, one summary per line. It is built a chunk
+// at a time while the editor is idle and repaired line by line after edits,
+// so matching and folding never relex the whole file. Whole lines are
+// skipped during matching using their net depth and minimum prefix/suffix.
+class StructureIndex {
+public:
+    // Lines lexed per idle tick
+    static constexpr int Chunk = 16384;
+
+    int built() const {
+        return (int)info.size();
+    }
+
+    bool complete(const std::vector<std::string>& lines) const {
+        return built() >= (int)lines.size();
+    }
+
+    void build(const std::vector<std::string>& lines, int budget) {
+        int end = std::min((int)lines.size(), built() + budget);
+        while (built() < end) {
+            int y = built();
+            info.emplace_back();
+            lex(lines[y], y > 0 ? info[y - 1].commentOut : false, info[y]);
+        }
+        gen++;
+    }
+
+    void ensure(const std::vector<std::string>& lines, int upTo) {
+        if (built() < upTo) build(lines, upTo - built());
+    }
+
+    // Edit hooks. Lines past built() are left for the background build.
+    void lineChanged(const std::vector<std::string>& lines, int y) {
+        repair(lines, y, y);
+    }
+
+    // Line y was split at the cursor into y and y + 1
+    void lineSplit(const std::vector<std::string>& lines, int y) {
+        if (y < built()) {
+            info.insert(info.begin() + y + 1, LineInfo());
+        }
+        repair(lines, y, y + 1);
+    }
+
+    // Line y + 1 was appended to line y and removed
+    void linesJoined(const std::vector<std::string>& lines, int y) {
+        if (y + 1 < built()) {
+            info.erase(info.begin() + y + 1);
+        }
+        repair(lines, y, y);
+    }
+
+    // Finds the bracket matching the one at or just before column x
+    bool findMatch(const std::vector<std::string>& lines, int y, int x, int& outY, int& outX) {
+        ensure(lines, y + 1);
+        const auto& br = info[y].brackets;
+
+        int k = -1;
+        for (int i = 0; i < (int)br.size(); i++) {
+            if (br[i].col == x) {
+                k = i;
+                break;
+            }
+            if (br[i].col == x - 1) k = i;
+        }
+        if (k < 0) return false;
+
+        int matchK;
+        bool found = isOpen(br[k].ch) ? matchForward(lines, y, k, outY, matchK)
+                                      : matchBackward(y, k, outY, matchK);
+        if (found) outX = info[outY].brackets[matchK].col;
+        return found;
+    }
+
+    // Last line of the block left open at the end of line y, or -1
+    int foldEnd(const std::vector<std::string>& lines, int y) {
+        ensure(lines, y + 1);
+        int k = firstUnmatchedOpen(info[y]);
+        if (k < 0) return -1;
+
+        int endY, endK;
+        if (!matchForward(lines, y, k, endY, endK) || endY == y) return -1;
+        return endY;
+    }
+
+    bool isFolded(int y) const {
+        return y < built() && info[y].folded;
+    }
+
+    void setFolded(const std::vector<std::string>& lines, int y, bool folded) {
+        ensure(lines, y + 1);
+        info[y].folded = folded;
+        gen++;
+    }
+
+    void unfoldAll() {
+        for (auto& li : info) li.folded = false;
+        gen++;
+    }
+
+    // Folds every block opened on a line at the same depth as line y
+    void foldLevel(const std::vector<std::string>& lines, int y) {
+        ensure(lines, (int)lines.size());
+
+        int depth = 0;
+        for (int j = 0; j < y; j++) depth += info[j].net;
+
+        int d = 0;
+        for (int j = 0; j < built(); j++) {
+            if (d == depth && firstUnmatchedOpen(info[j]) >= 0) info[j].folded = true;
+            d += info[j].net;
+        }
+        gen++;
+    }
+
+    // Start of the outermost fold hiding line y, or -1 if y is visible
+    int hiddenBy(const std::vector<std::string>& lines, int y) {
+        const auto& f = folds(lines);
+        auto it = std::upper_bound(f.begin(), f.end(), std::make_pair(y, -1));
+        if (it == f.begin()) return -1;
+        --it;
+        return (it->first < y && y <= it->second) ? it->first : -1;
+    }
+
+    // Last hidden line if y starts a fold, or -1
+    int foldedEnd(const std::vector<std::string>& lines, int y) {
+        const auto& f = folds(lines);
+        auto it = std::lower_bound(f.begin(), f.end(), std::make_pair(y, -1));
+        return (it != f.end() && it->first == y) ? it->second : -1;
+    }
+
+    // Outermost folds as sorted, disjoint [start, end] ranges. Recomputed
+    // only after the index or fold flags change.
+    const std::vector<std::pair<int, int>>& folds(const std::vector<std::string>& lines) {
+        if (foldsGen == gen) return foldRanges;
+
+        foldRanges.clear();
+        for (int y = 0; y < built(); y++) {
+            if (!info[y].folded) continue;
+
+            int end = foldEnd(lines, y);
+            if (end < 0) {
+                info[y].folded = false;
+                continue;
+            }
+            foldRanges.push_back({y, end});
+            y = end;
+        }
+        foldsGen = gen;
+        return foldRanges;
+    }
+
+private:
+    struct Bracket {
+        int col;
+        char ch;
+    };
+
+    struct LineInfo {
+        std::vector<Bracket> brackets;
+        int net = 0;        // opens - closes
+        int minPrefix = 0;  // lowest depth reached scanning left to right
+        int minSuffix = 0;  // same, right to left with closers counting up
+        bool commentIn = false;
+        bool commentOut = false;
+        bool folded = false;
+    };
+
+    std::vector<LineInfo> info;
+    std::vector<std::pair<int, int>> foldRanges;
+    unsigned gen = 1;
+    unsigned foldsGen = 0;
+
+    static bool isOpen(char c) {
+        return c == '{' || c == '[' || c == '(';
+    }
+
+    static bool pairs(char open, char close) {
+        return (open == '{' && close == '}') || (open == '[' && close == ']') ||
+               (open == '(' && close == ')');
+    }
+
+    // Collects brackets outside strings, char literals and comments. Only
+    // block comments carry state from one line to the next.
+    static void lex(const std::string& s, bool commentIn, LineInfo& li) {
+        li.brackets.clear();
+        li.commentIn = commentIn;
+
+        bool inComment = commentIn;
+        bool inString = false;
+        int n = (int)s.size();
+
+        for (int i = 0; i < n; i++) {
+            char c = s[i];
+            char next = i + 1 < n ? s[i + 1] : 0;
+
+            if (inComment) {
+                if (c == '*' && next == '/') {
+                    inComment = false;
+                    i++;
+                }
+            } else if (inString) {
+                if (c == '\\') i++;
+                else if (c == '"') inString = false;
+            } else if (c == '"') {
+                inString = true;
+            } else if (c == '\'') {
+                // Only skip real char literals, apostrophes in prose stay
+                if (next == '\\' && i + 3 < n && s[i + 3] == '\'') i += 3;
+                else if (i + 2 < n && s[i + 2] == '\'') i += 2;
+            } else if (c == '/' && next == '/') {
+                break;
+            } else if (c == '/' && next == '*') {
+                inComment = true;
+                i++;
+            } else if (c == '{' || c == '[' || c == '(' || c == '}' || c == ']' || c == ')') {
+                li.brackets.push_back({i, c});
+            }
+        }
+        li.commentOut = inComment;
+
+        int d = 0;
+        li.minPrefix = 0;
+        for (const auto& b : li.brackets) {
+            d += isOpen(b.ch) ? 1 : -1;
+            li.minPrefix = std::min(li.minPrefix, d);
+        }
+        li.net = d;
+
+        d = 0;
+        li.minSuffix = 0;
+        for (auto it = li.brackets.rbegin(); it != li.brackets.rend(); ++it) {
+            d += isOpen(it->ch) ? -1 : 1;
+            li.minSuffix = std::min(li.minSuffix, d);
+        }
+    }
+
+    // Relexes lines from..to, then keeps going while a block comment
+    // boundary moved and the following lines were lexed with stale state.
+    void repair(const std::vector<std::string>& lines, int from, int to) {
+        to = std::min(to, built() - 1);
+        for (int y = from; y <= to; y++) {
+            lex(lines[y], y > 0 ? info[y - 1].commentOut : false, info[y]);
+        }
+        for (int y = std::max(to + 1, 1); y < built() && info[y].commentIn != info[y - 1].commentOut; y++) {
+            lex(lines[y], info[y - 1].commentOut, info[y]);
+        }
+        gen++;
+    }
+
+    // Index of the opener that stays open at the end of the line, or -1
+    static int firstUnmatchedOpen(const LineInfo& li) {
+        if (li.net - li.minPrefix <= 0) return -1;
+
+        int d = 0, low = 0, start = 0;
+        for (int i = 0; i < (int)li.brackets.size(); i++) {
+            d += isOpen(li.brackets[i].ch) ? 1 : -1;
+            if (d <= low) {
+                low = d;
+                start = i + 1;
+            }
+        }
+        return start < (int)li.brackets.size() ? start : -1;
+    }
+
+    bool matchForward(const std::vector<std::string>& lines, int y, int k, int& outY, int& outK) {
+        // Depth counts every kind, but the bracket that closes the block
+        // must be the right one; unbalanced code gets no match
+        char open = info[y].brackets[k].ch;
+        int d = 0;
+        for (int i = k + 1; i < (int)info[y].brackets.size(); i++) {
+            if (isOpen(info[y].brackets[i].ch)) d++;
+            else if (d-- == 0) {
+                outY = y;
+                outK = i;
+                return pairs(open, info[y].brackets[i].ch);
+            }
+        }
+
+        for (int j = y + 1; j < (int)lines.size(); j++) {
+            if (j >= built()) build(lines, Chunk);
+
+            const LineInfo& li = info[j];
+            if (d + li.minPrefix >= 0) {
+                d += li.net;
+                continue;
+            }
+            for (int i = 0; i < (int)li.brackets.size(); i++) {
+                if (isOpen(li.brackets[i].ch)) d++;
+                else if (d-- == 0) {
+                    outY = j;
+                    outK = i;
+                    return pairs(open, li.brackets[i].ch);
+                }
+            }
+        }
+        return false;
+    }
+
+    bool matchBackward(int y, int k, int& outY, int& outK) {
+        char close = info[y].brackets[k].ch;
+        int d = 0;
+        for (int j = y; j >= 0; j--) {
+            const LineInfo& li = info[j];
+            int i = j == y ? k - 1 : (int)li.brackets.size() - 1;
+
+            if (j != y && d + li.minSuffix >= 0) {
+                d -= li.net;
+                continue;
+            }
+            for (; i >= 0; i--) {
+                if (!isOpen(li.brackets[i].ch)) d++;
+                else if (d-- == 0) {
+                    outY = j;
+                    outK = i;
+                    return pairs(li.brackets[i].ch, close);
+                }
+            }
+        }
+        return false;
+    }
+};
+
 struct Config {
     std::string bgColor = "000a0f";
     std::string fgColor = "ffffff";
     int browserWidth = 20;
     std::map<std::string, std::string> keys;
+    std::vector<std::string> excludes;
+};
+
+// Gitignore-style pattern set. Each pattern is compiled once into a small
+// token program; plain names and "*.ext" patterns get string-compare fast
+// paths, everything else runs as a state-set simulation that is linear in
+// the path length regardless of how many wildcards the pattern has.
+class IgnoreMatcher {
+public:
+    void addPattern(std::string line) {
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (line.empty() || line[0] == '#') return;
+
+        Rule rule;
+        if (line[0] == '!') {
+            rule.negate = true;
+            line.erase(0, 1);
+        }
+        if (!line.empty() && line.back() == '/') {
+            rule.dirOnly = true;
+            line.pop_back();
+        }
+        if (line.empty()) return;
+
+        // A slash anywhere but the end anchors the pattern to the tree root
+        rule.anchored = line.find('/') != std::string::npos;
+        if (line[0] == '/') line.erase(0, 1);
+        if (line.empty()) return;
+
+        if (line.find_first_of("*?[\\") == std::string::npos) {
+            rule.kind = RuleKind::Literal;
+            rule.text = line;
+        } else if (!rule.anchored && line[0] == '*' && line.size() > 1 &&
+                   line.find_first_of("*?[\\/", 1) == std::string::npos) {
+            // Basename-only; anchored "/*.ext" needs the glob so '*' stops at '/'
+            rule.kind = RuleKind::Suffix;
+            rule.text = line.substr(1);
+        } else {
+            rule.kind = RuleKind::Glob;
+            rule.prog = compile(line);
+        }
+
+        rules.push_back(std::move(rule));
+    }
+
+    void addFile(const std::string& path) {
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line)) {
+            addPattern(line);
+        }
+    }
+
+    void clear() {
+        rules.clear();
+    }
+
+    // relPath is relative to the tree root, without a leading "./".
+    // The last matching rule wins, so "!" patterns can re-include.
+    bool isIgnored(const std::string& relPath, bool isDir) const {
+        if (rules.empty()) return false;
+
+        size_t slash = relPath.rfind('/');
+        std::string_view path(relPath);
+        std::string_view base = slash == std::string::npos ? path : path.substr(slash + 1);
+
+        for (auto it = rules.rbegin(); it != rules.rend(); ++it) {
+            const Rule& rule = *it;
+            if (rule.dirOnly && !isDir) continue;
+
+            std::string_view subject = rule.anchored ? path : base;
+            bool hit = false;
+            switch (rule.kind) {
+                case RuleKind::Literal:
+                    hit = subject == rule.text;
+                    break;
+                case RuleKind::Suffix:
+                    hit = subject.size() >= rule.text.size() &&
+                          subject.compare(subject.size() - rule.text.size(),
+                                          rule.text.size(), rule.text) == 0;
+                    break;
+                case RuleKind::Glob:
+                    hit = run(rule.prog, subject);
+                    break;
+            }
+            if (hit) return !rule.negate;
+        }
+        return false;
+    }
+
+private:
+    // Star stays inside one path segment, DoubleStar crosses segments and
+    // DirStar is "**/": zero or more whole directories.
+    enum class TokType { Char, Any, Class, Star, DoubleStar, DirStar };
+
+    struct Token {
+        TokType type;
+        char ch;
+        std::bitset<256> set;
+
+        Token(TokType t, char c = 0) : type(t), ch(c) {}
+    };
+
+    enum class RuleKind { Literal, Suffix, Glob };
+
+    struct Rule {
+        RuleKind kind = RuleKind::Literal;
+        std::string text;
+        std::vector<Token> prog;
+        bool negate = false;
+        bool dirOnly = false;
+        bool anchored = false;
+    };
+
+    std::vector<Rule> rules;
+
+    static std::vector<Token> compile(const std::string& pat) {
+        std::vector<Token> prog;
+        size_t i = 0;
+        while (i < pat.size()) {
+            char c = pat[i];
+            if (c == '*') {
+                bool dbl = i + 1 < pat.size() && pat[i + 1] == '*';
+                bool atSegStart = i == 0 || pat[i - 1] == '/';
+                if (dbl && atSegStart && i + 2 < pat.size() && pat[i + 2] == '/') {
+                    prog.push_back({TokType::DirStar});
+                    i += 3;
+                } else if (dbl && atSegStart && i + 2 == pat.size()) {
+                    prog.push_back({TokType::DoubleStar});
+                    i += 2;
+                } else {
+                    // Runs of stars inside a segment collapse to one
+                    while (i < pat.size() && pat[i] == '*') i++;
+                    prog.push_back({TokType::Star});
+                }
+            } else if (c == '?') {
+                prog.push_back({TokType::Any});
+                i++;
+            } else if (c == '[' && pat.find(']', i + 2) != std::string::npos) {
+                Token tok{TokType::Class};
+                i++;
+                bool negate = pat[i] == '!' || pat[i] == '^';
+                if (negate) i++;
+                // A ']' right after the opening bracket is a literal member
+                size_t start = i;
+                while (i < pat.size() && (pat[i] != ']' || i == start)) {
+                    unsigned char lo = pat[i];
+                    if (i + 2 < pat.size() && pat[i + 1] == '-' && pat[i + 2] != ']') {
+                        unsigned char hi = pat[i + 2];
+                        for (int ch = lo; ch <= hi; ch++) tok.set.set(ch);
+                        i += 3;
+                    } else {
+                        tok.set.set(lo);
+                        i++;
+                    }
+                }
+                i++;
+                if (negate) tok.set.flip();
+                tok.set.reset('/');
+                prog.push_back(tok);
+            } else {
+                if (c == '\\' && i + 1 < pat.size()) c = pat[++i];
+                prog.push_back({TokType::Char, c});
+                i++;
+            }
+        }
+        return prog;
+    }
+
+    // State flags: Entered means the token was just reached, Inside means a
+    // DirStar has consumed characters and must finish its segment with '/'.
+    static constexpr char Entered = 1;
+    static constexpr char Inside = 2;
+
+    // Wildcard states may be skipped without consuming input. DirStar only
+    // on entry, so "**/foo" can't start matching partway through a segment.
+    static void closure(const std::vector<Token>& prog, std::vector<char>& states) {
+        for (size_t i = 0; i < prog.size(); i++) {
+            TokType t = prog[i].type;
+            bool skip = t == TokType::DirStar ? (states[i] & Entered)
+                                              : states[i] && (t == TokType::Star || t == TokType::DoubleStar);
+            if (skip) states[i + 1] |= Entered;
+        }
+    }
+
+    static bool run(const std::vector<Token>& prog, std::string_view s) {
+        std::vector<char> cur(prog.size() + 1, 0), next(prog.size() + 1, 0);
+        cur[0] = Entered;
+        closure(prog, cur);
+
+        for (char c : s) {
+            std::fill(next.begin(), next.end(), 0);
+            bool any = false;
+            for (size_t i = 0; i < prog.size(); i++) {
+                if (!cur[i]) continue;
+                const Token& tok = prog[i];
+                switch (tok.type) {
+                    case TokType::Char:
+                        if (c == tok.ch) {
+                            next[i + 1] |= Entered;
+                            any = true;
+                        }
+                        break;
+                    case TokType::Any:
+                        if (c != '/') {
+                            next[i + 1] |= Entered;
+                            any = true;
+                        }
+                        break;
+                    case TokType::Class:
+                        if (tok.set.test((unsigned char)c)) {
+                            next[i + 1] |= Entered;
+                            any = true;
+                        }
+                        break;
+                    case TokType::Star:
+                        if (c != '/') {
+                            next[i] |= Entered;
+                            any = true;
+                        }
+                        break;
+                    case TokType::DoubleStar:
+                        next[i] |= Entered;
+                        any = true;
+                        break;
+                    case TokType::DirStar:
+                        next[i] |= Inside;
+                        any = true;
+                        if (c == '/') next[i + 1] |= Entered;
+                        break;
+                }
+            }
+            if (!any) return false;
+            closure(prog, next);
+            cur.swap(next);
+        }
+        return cur[prog.size()] != 0;
+    }
 };
 
 struct Tab {
     std::string filename;
     std::vector<std::string> lines;
+    LineHashes lineHashes;
     int cursorX = 0;
     int cursorY = 0;
     bool modified = false;
+
+    // Hash and stat of the version last read from or written to disk
+    bool onDisk = false;
+    uint64_t diskHash = 0;
+    fs::file_time_type diskTime;
+    uintmax_t diskSize = 0;
+    bool diskChanged = false;
+    bool overwriteArmed = false;
+
+    StructureIndex index;
 };
 
 struct FileEntry {
@@ -65,9 +915,12 @@ private:
     int selectedEntryIdx = 0;
     bool focusBrowser = false;
     bool showHidden = false;
+    bool showIgnored = false;
+    IgnoreMatcher ignore;
     EditorMode mode = EditorMode::EDIT;
     bool waitingForCommand = false;
     std::string inputBuffer;
+    std::string statusMessage;
     int screenHeight, screenWidth;
     int browserWidth;
     int scrollY = 0;
@@ -109,6 +962,16 @@ private:
                     else if (key == "BrowserWidth") config.browserWidth = std::stoi(val);
                 } else if (section == "keys") {
                     config.keys[key] = val;
+                } else if (section == "browser") {
+                    if (key == "Exclude") {
+                        std::stringstream ss(val);
+                        std::string pat;
+                        while (std::getline(ss, pat, ',')) {
+                            pat.erase(0, pat.find_first_not_of(" \t"));
+                            pat.erase(pat.find_last_not_of(" \t") + 1);
+                            if (!pat.empty()) config.excludes.push_back(pat);
+                        }
+                    }
                 }
             }
         }
@@ -146,27 +1009,50 @@ private:
         wbkgd(statusWin,  COLOR_PAIR(1));
     }
 
-    // Loads only the top-level entries of a directory into allEntries.
-    // Expansion of subdirectories is handled by rebuildVisibleEntries.
-    void loadDirectoryEntries(const std::string& path, int depth) {
+    // Rebuilds the ignore matcher from serene.ini excludes and ./.gitignore.
+    // Patterns are compiled here once per tree load, not per entry.
+    void loadIgnoreRules() {
+        ignore.clear();
+        for (const auto& pat : config.excludes) {
+            ignore.addPattern(pat);
+        }
+        ignore.addFile(".gitignore");
+    }
+
+    // Filter applied while scanning, so hidden or ignored directories are
+    // never enumerated.
+    bool isFiltered(const std::string& fname, const std::string& fullPath, bool isDir) const {
+        if (fname[0] == '.' && !showHidden) return true;
+        if (showIgnored) return false;
+
+        std::string rel = fullPath;
+        if (rel.compare(0, 2, "./") == 0) rel.erase(0, 2);
+        return ignore.isIgnored(rel, isDir);
+    }
+
+    // Lists one directory level, filtered and sorted (folders first).
+    std::vector<FileEntry> scanDirectory(const std::string& path, int depth) {
         std::vector<FileEntry> entries;
 
         try {
             for (const auto& entry : fs::directory_iterator(path)) {
                 std::string fname = entry.path().filename().string();
-                if (fname[0] == '.' && !showHidden) continue;
+                std::error_code ec;
+                bool isDir = entry.is_directory(ec);
+                std::string fullPath = entry.path().string();
+                if (isFiltered(fname, fullPath, isDir)) continue;
 
                 FileEntry fe;
                 fe.name = fname;
-                fe.fullPath = entry.path().string();
-                fe.isDir = fs::is_directory(entry);
+                fe.fullPath = fullPath;
+                fe.isDir = isDir;
                 fe.depth = depth;
                 fe.expanded = false;
 
                 entries.push_back(fe);
             }
         } catch (...) {
-            return;
+            return {};
         }
 
         std::sort(entries.begin(), entries.end(), [](const FileEntry& a, const FileEntry& b) {
@@ -174,6 +1060,13 @@ private:
             return a.name < b.name;
         });
 
+        return entries;
+    }
+
+    // Loads only the top-level entries of a directory into allEntries.
+    // Expansion of subdirectories is handled by rebuildVisibleEntries.
+    void loadDirectoryEntries(const std::string& path, int depth) {
+        std::vector<FileEntry> entries = scanDirectory(path, depth);
         allEntries.insert(allEntries.end(), entries.begin(), entries.end());
     }
 
@@ -184,31 +1077,7 @@ private:
             visibleEntries.push_back(entry);
 
             if (entry.isDir && entry.expanded) {
-                std::vector<FileEntry> children;
-
-                try {
-                    for (const auto& child : fs::directory_iterator(entry.fullPath)) {
-                        std::string fname = child.path().filename().string();
-                        if (fname[0] == '.' && !showHidden) continue;
-
-                        FileEntry fe;
-                        fe.name = fname;
-                        fe.fullPath = child.path().string();
-                        fe.isDir = fs::is_directory(child);
-                        fe.depth = entry.depth + 1;
-                        fe.expanded = false;
-
-                        children.push_back(fe);
-                    }
-                } catch (...) {
-                    continue;
-                }
-
-                std::sort(children.begin(), children.end(), [](const FileEntry& a, const FileEntry& b) {
-                    if (a.isDir != b.isDir) return a.isDir > b.isDir;
-                    return a.name < b.name;
-                });
-
+                std::vector<FileEntry> children = scanDirectory(entry.fullPath, entry.depth + 1);
                 visibleEntries.insert(visibleEntries.end(), children.begin(), children.end());
             }
         }
@@ -216,21 +1085,154 @@ private:
 
     void loadFileTree() {
         allEntries.clear();
+        loadIgnoreRules();
         loadDirectoryEntries(".", 0);
         rebuildVisibleEntries();
     }
 
-    void saveCurrentFile() {
-        if (tabs.empty()) return;
+    void recordDiskStat(Tab& tab) {
+        std::error_code ec;
+        tab.diskTime = fs::last_write_time(tab.filename, ec);
+        tab.diskSize = ec ? 0 : fs::file_size(tab.filename, ec);
+        tab.onDisk = !ec;
+    }
+
+    // Detects edits made to the file underneath us. Only stats it unless
+    // size or mtime moved, in which case the content is rehashed so a plain
+    // touch doesn't count. Returns true while the tab is in conflict.
+    bool checkDiskChange(Tab& tab) {
+        std::error_code ec;
+        fs::file_time_type time = fs::last_write_time(tab.filename, ec);
+        if (ec) return tab.diskChanged;
+        uintmax_t size = fs::file_size(tab.filename, ec);
+        if (ec) return tab.diskChanged;
+
+        if (tab.onDisk && time == tab.diskTime && size == tab.diskSize) {
+            return tab.diskChanged;
+        }
+
+        bool wasOnDisk = tab.onDisk;
+        tab.onDisk = true;
+        tab.diskTime = time;
+        tab.diskSize = size;
+
+        uint64_t hash = hashFile(tab.filename);
+        if (wasOnDisk && hash == tab.diskHash) return tab.diskChanged;
+
+        // Buffer still matches the old disk version: nothing of the user's to
+        // lose, so pick up the new content instead of flagging a conflict
+        bool untouched = wasOnDisk ? tab.lineHashes.digest() == tab.diskHash : !tab.modified;
+        tab.overwriteArmed = false;
+
+        if (untouched) {
+            tab.lines = readLines(tab.filename);
+            tab.lineHashes.assign(tab.lines);
+            tab.diskHash = tab.lineHashes.digest();
+            tab.modified = false;
+            tab.diskChanged = false;
+            tab.index = StructureIndex();
+
+            tab.cursorY = std::min(tab.cursorY, (int)tab.lines.size() - 1);
+            tab.cursorX = std::min(tab.cursorX, (int)tab.lines[tab.cursorY].length());
+            scrollY = std::min(scrollY, tab.cursorY);
+
+            statusMessage = "reloaded " + tab.filename + " from disk";
+            return false;
+        }
+
+        tab.diskHash = hash;
+        tab.modified = tab.lineHashes.digest() != hash;
+        tab.diskChanged = tab.modified;
+        if (tab.diskChanged) {
+            statusMessage = tab.filename + " changed on disk";
+        }
+        return tab.diskChanged;
+    }
+
+    // Returns false if the write was held back because the file changed on
+    // disk; saving again overwrites it.
+    bool saveCurrentFile() {
+        if (tabs.empty()) return true;
 
         Tab& tab = tabs[activeTab];
+
+        if (checkDiskChange(tab) && !tab.overwriteArmed) {
+            tab.overwriteArmed = true;
+            statusMessage = "changed on disk, save again to overwrite";
+            return false;
+        }
+
+        uint64_t hash = tab.lineHashes.digest();
+        if (tab.onDisk && hash == tab.diskHash) {
+            // Identical content: leave the file and its mtime alone
+            tab.modified = false;
+            tab.diskChanged = false;
+            tab.overwriteArmed = false;
+            return true;
+        }
+
         std::ofstream file(tab.filename);
 
         if (file.is_open()) {
             for (const auto& line : tab.lines) {
                 file << line << "\n";
             }
+            file.close();
+
+            tab.diskHash = hash;
             tab.modified = false;
+            tab.diskChanged = false;
+            tab.overwriteArmed = false;
+            recordDiskStat(tab);
+        }
+        return true;
+    }
+
+    // Next line shown on screen after y, stepping over a fold, or -1
+    int nextVisibleLine(Tab& tab, int y) {
+        int end = tab.index.foldedEnd(tab.lines, y);
+        int next = (end >= 0 ? end : y) + 1;
+        return next < (int)tab.lines.size() ? next : -1;
+    }
+
+    int prevVisibleLine(Tab& tab, int y) {
+        if (y <= 0) return -1;
+        int start = tab.index.hiddenBy(tab.lines, y - 1);
+        return start >= 0 ? start : y - 1;
+    }
+
+    // Screen row of line y counted from scrollY, or -1 if it isn't on screen
+    int visibleRow(Tab& tab, int y) {
+        int maxDisplay = screenHeight - 3;
+        int row = 0;
+        for (int line = scrollY; line >= 0 && line <= y && row < maxDisplay; row++) {
+            if (line == y) return row;
+            line = nextVisibleLine(tab, line);
+        }
+        return -1;
+    }
+
+    // Opens any fold hiding the cursor line and scrolls it into view
+    void revealCursor(Tab& tab) {
+        int start;
+        while ((start = tab.index.hiddenBy(tab.lines, tab.cursorY)) >= 0) {
+            tab.index.setFolded(tab.lines, start, false);
+        }
+
+        int hidden = tab.index.hiddenBy(tab.lines, scrollY);
+        if (hidden >= 0) scrollY = hidden;
+
+        if (tab.cursorY < scrollY) {
+            scrollY = tab.cursorY;
+        } else if (visibleRow(tab, tab.cursorY) < 0) {
+            // Put the cursor on the bottom row, as KEY_DOWN does
+            int maxDisplay = screenHeight - 3;
+            scrollY = tab.cursorY;
+            for (int i = 1; i < maxDisplay; i++) {
+                int prev = prevVisibleLine(tab, scrollY);
+                if (prev < 0) break;
+                scrollY = prev;
+            }
         }
     }
 
@@ -259,6 +1261,7 @@ private:
 
         std::string header = focusBrowser ? "---OPEN---" : "---EDIT---";
         if (showHidden) header += " [H]";
+        if (showIgnored) header += " [I]";
         mvwprintw(browserWin, 0, 0, "%s", header.c_str());
 
         int maxDisplay = screenHeight - 4;
@@ -320,8 +1323,18 @@ private:
         Tab& tab = tabs[activeTab];
         int maxDisplay = screenHeight - 3;
 
-        for (int i = 0; i < maxDisplay && (scrollY + i) < (int)tab.lines.size(); i++) {
-            mvwprintw(editorWin, i, 1, "%s", tab.lines[scrollY + i].c_str());
+        int y = scrollY;
+        for (int i = 0; i < maxDisplay && y >= 0 && y < (int)tab.lines.size(); i++) {
+            int end = tab.index.foldedEnd(tab.lines, y);
+            if (end >= 0) {
+                std::string tail = tab.lines[end];
+                tail.erase(0, tail.find_first_not_of(" \t"));
+                std::string folded = tab.lines[y] + " ... " + tail;
+                mvwprintw(editorWin, i, 1, "%s", folded.c_str());
+            } else {
+                mvwprintw(editorWin, i, 1, "%s", tab.lines[y].c_str());
+            }
+            y = nextVisibleLine(tab, y);
         }
 
         wrefresh(editorWin);
@@ -340,10 +1353,10 @@ private:
 
         curs_set(1);
         Tab& tab = tabs[activeTab];
-        int maxDisplay = screenHeight - 3;
+        int row = visibleRow(tab, tab.cursorY);
 
-        if (tab.cursorY >= scrollY && tab.cursorY < scrollY + maxDisplay) {
-            wmove(editorWin, tab.cursorY - scrollY, tab.cursorX + 1);
+        if (row >= 0) {
+            wmove(editorWin, row, tab.cursorX + 1);
             wrefresh(editorWin);
         }
     }
@@ -356,11 +1369,11 @@ private:
             curs_set(1);
             wmove(statusWin, 0, 13 + (int)inputBuffer.length());
         } else if (mode == EditorMode::COMMAND) {
-            if (waitingForCommand) {
-                mvwprintw(statusWin, 0, 0, "> !");
-            } else {
-                mvwprintw(statusWin, 0, 0, "> ");
-            }
+            // Command results (save conflicts, failed jumps) show here until
+            // the next key, whatever state the prompt is in
+            std::string prompt = waitingForCommand ? "> !" : ">";
+            if (!statusMessage.empty()) prompt += " " + statusMessage;
+            mvwprintw(statusWin, 0, 0, "%s", prompt.c_str());
             curs_set(0);
         } else {
             std::string status = "ESC:cmd | C-E:browse";
@@ -369,9 +1382,15 @@ private:
                 status += " [" + std::to_string(tabs[activeTab].cursorY + 1) + ":" +
                           std::to_string(tabs[activeTab].cursorX + 1) + "]";
                 if (tabs[activeTab].modified) status += " *";
+                if (tabs[activeTab].diskChanged) status += " [disk changed]";
+                if (!tabs[activeTab].index.complete(tabs[activeTab].lines)) status += " [indexing]";
                 status += " | ESC:cmd | C-E:browse";
             }
 
+            if (!statusMessage.empty()) {
+                status += " | " + statusMessage;
+            }
+
             mvwprintw(statusWin, 0, 0, "%s", status.c_str());
         }
 
@@ -397,6 +1416,12 @@ private:
             return;
         }
 
+        if (ch == 'i' || ch == 'I') {
+            showIgnored = !showIgnored;
+            loadFileTree();
+            return;
+        }
+
         switch (ch) {
             case KEY_UP:
                 if (selectedEntryIdx > 0) {
@@ -467,9 +1492,10 @@ private:
                 saveCurrentFile();
                 break;
             case 'q':
-                saveCurrentFile();
-                endwin();
-                exit(0);
+                if (saveCurrentFile()) {
+                    endwin();
+                    exit(0);
+                }
                 break;
             case 'n':
                 mode = EditorMode::INPUT;
@@ -488,18 +1514,59 @@ private:
                         activeTab = 0;
                     }
                     scrollY = 0;
+                    if (!tabs.empty()) checkDiskChange(tabs[activeTab]);
+                }
+                break;
+            case 'm':
+                if (!tabs.empty()) {
+                    Tab& tab = tabs[activeTab];
+                    int y, x;
+                    if (tab.index.findMatch(tab.lines, tab.cursorY, tab.cursorX, y, x)) {
+                        tab.cursorY = y;
+                        tab.cursorX = x;
+                        revealCursor(tab);
+                    } else {
+                        statusMessage = "no matching bracket";
+                    }
+                }
+                break;
+            case 'f':
+                if (!tabs.empty()) {
+                    Tab& tab = tabs[activeTab];
+                    if (tab.index.isFolded(tab.cursorY)) {
+                        tab.index.setFolded(tab.lines, tab.cursorY, false);
+                    } else if (tab.index.foldEnd(tab.lines, tab.cursorY) >= 0) {
+                        tab.index.setFolded(tab.lines, tab.cursorY, true);
+                    } else {
+                        statusMessage = "nothing to fold";
+                    }
+                }
+                break;
+            case 'c':
+                if (!tabs.empty()) {
+                    Tab& tab = tabs[activeTab];
+                    tab.index.foldLevel(tab.lines, tab.cursorY);
+                    if (tab.index.folds(tab.lines).empty()) statusMessage = "nothing to fold";
+                    revealCursor(tab);
+                }
+                break;
+            case 'u':
+                if (!tabs.empty()) {
+                    tabs[activeTab].index.unfoldAll();
                 }
                 break;
             case 'p':
                 if (!tabs.empty()) {
                     activeTab = (activeTab + 1) % (int)tabs.size();
                     scrollY = 0;
+                    checkDiskChange(tabs[activeTab]);
                 }
                 break;
             case 'o':
                 if (!tabs.empty()) {
                     activeTab = (activeTab - 1 + (int)tabs.size()) % (int)tabs.size();
                     scrollY = 0;
+                    checkDiskChange(tabs[activeTab]);
                 }
                 break;
         }
@@ -518,21 +1585,27 @@ private:
         if (tabs.empty()) return;
 
         Tab& tab = tabs[activeTab];
+        bool edited = false;
 
         switch (ch) {
             case KEY_UP:
-                if (tab.cursorY > 0) {
-                    tab.cursorY--;
-                    tab.cursorX = std::min(tab.cursorX, (int)tab.lines[tab.cursorY].length());
-                    if (tab.cursorY < scrollY) scrollY = tab.cursorY;
+                {
+                    int prev = prevVisibleLine(tab, tab.cursorY);
+                    if (prev >= 0) {
+                        tab.cursorY = prev;
+                        tab.cursorX = std::min(tab.cursorX, (int)tab.lines[tab.cursorY].length());
+                        if (tab.cursorY < scrollY) scrollY = tab.cursorY;
+                    }
                 }
                 break;
             case KEY_DOWN:
-                if (tab.cursorY < (int)tab.lines.size() - 1) {
-                    tab.cursorY++;
-                    tab.cursorX = std::min(tab.cursorX, (int)tab.lines[tab.cursorY].length());
-                    int maxDisplay = screenHeight - 3;
-                    if (tab.cursorY >= scrollY + maxDisplay) scrollY = tab.cursorY - maxDisplay + 1;
+                {
+                    int next = nextVisibleLine(tab, tab.cursorY);
+                    if (next >= 0) {
+                        tab.cursorY = next;
+                        tab.cursorX = std::min(tab.cursorX, (int)tab.lines[tab.cursorY].length());
+                        if (visibleRow(tab, tab.cursorY) < 0) scrollY = nextVisibleLine(tab, scrollY);
+                    }
                 }
                 break;
             case KEY_LEFT:
@@ -546,13 +1619,18 @@ private:
                 if (tab.cursorX > 0) {
                     tab.lines[tab.cursorY].erase(tab.cursorX - 1, 1);
                     tab.cursorX--;
-                    tab.modified = true;
+                    tab.lineHashes.set(tab.cursorY, tab.lines[tab.cursorY]);
+                    tab.index.lineChanged(tab.lines, tab.cursorY);
+                    edited = true;
                 } else if (tab.cursorY > 0) {
                     tab.cursorX = (int)tab.lines[tab.cursorY - 1].length();
                     tab.lines[tab.cursorY - 1] += tab.lines[tab.cursorY];
                     tab.lines.erase(tab.lines.begin() + tab.cursorY);
                     tab.cursorY--;
-                    tab.modified = true;
+                    tab.lineHashes.erase(tab.cursorY + 1);
+                    tab.lineHashes.set(tab.cursorY, tab.lines[tab.cursorY]);
+                    tab.index.linesJoined(tab.lines, tab.cursorY);
+                    edited = true;
                 }
                 break;
             case '\n':
@@ -561,19 +1639,36 @@ private:
                     std::string rest = tab.lines[tab.cursorY].substr(tab.cursorX);
                     tab.lines[tab.cursorY] = tab.lines[tab.cursorY].substr(0, tab.cursorX);
                     tab.lines.insert(tab.lines.begin() + tab.cursorY + 1, rest);
+                    tab.lineHashes.set(tab.cursorY, tab.lines[tab.cursorY]);
+                    tab.lineHashes.insert(tab.cursorY + 1, rest);
+                    tab.index.lineSplit(tab.lines, tab.cursorY);
                     tab.cursorY++;
                     tab.cursorX = 0;
-                    tab.modified = true;
+                    edited = true;
                 }
                 break;
             default:
                 if (ch >= 32 && ch < 127) {
                     tab.lines[tab.cursorY].insert(tab.cursorX, 1, ch);
                     tab.cursorX++;
-                    tab.modified = true;
+                    tab.lineHashes.set(tab.cursorY, tab.lines[tab.cursorY]);
+                    tab.index.lineChanged(tab.lines, tab.cursorY);
+                    edited = true;
                 }
                 break;
         }
+
+        // Compare against disk rather than latching, so undoing a change by
+        // hand clears the modified marker again
+        if (edited) {
+            tab.modified = !tab.onDisk || tab.lineHashes.digest() != tab.diskHash;
+            // Editing the buffer into the new disk content resolves a conflict
+            if (!tab.modified) {
+                tab.diskChanged = false;
+                tab.overwriteArmed = false;
+            }
+            revealCursor(tab);
+        }
     }
 
 public:
@@ -623,24 +1718,18 @@ public:
         for (size_t i = 0; i < tabs.size(); i++) {
             if (tabs[i].filename == filename) {
                 activeTab = (int)i;
+                checkDiskChange(tabs[i]);
                 return;
             }
         }
 
         Tab tab;
         tab.filename = filename;
+        tab.lines = readLines(filename);
 
-        std::ifstream file(filename);
-        if (file.is_open()) {
-            std::string line;
-            while (std::getline(file, line)) {
-                tab.lines.push_back(line);
-            }
-        }
-
-        if (tab.lines.empty()) {
-            tab.lines.push_back("");
-        }
+        recordDiskStat(tab);
+        tab.lineHashes.assign(tab.lines);
+        if (tab.onDisk) tab.diskHash = tab.lineHashes.digest();
 
         tabs.push_back(tab);
         activeTab = (int)tabs.size() - 1;
@@ -658,11 +1747,20 @@ public:
                 continue;
             }
 
-            if (focusBrowser) {
-                ch = wgetch(browserWin);
-            } else {
-                ch = wgetch(editorWin);
+            // Build the active buffer's structure index while no key is
+            // pending; wgetch blocks again once it is complete
+            WINDOW* inputWin = focusBrowser ? browserWin : editorWin;
+            bool indexing = !tabs.empty() && !tabs[activeTab].index.complete(tabs[activeTab].lines);
+            wtimeout(inputWin, indexing ? 0 : -1);
+
+            ch = wgetch(inputWin);
+            if (ch == ERR) {
+                if (indexing) {
+                    tabs[activeTab].index.build(tabs[activeTab].lines, StructureIndex::Chunk);
+                }
+                continue;
             }
+            statusMessage.clear();
 
             // Global keys
             if (ch == 27) { // ESC
@@ -678,6 +1776,7 @@ public:
 
             if (ch == getCtrlKey('e')) {
                 focusBrowser = !focusBrowser;
+                if (!focusBrowser && !tabs.empty()) checkDiskChange(tabs[activeTab]);
                 continue;
             }
 